@@ -0,0 +1,40 @@
+// Count heap allocations for benchmarks. This file is only built with
+// SCRIBE_ALLOCATION_COUNTER, and logspy is then linked with --wrap=malloc,calloc,realloc so
+// allocations made by libraries such as rapidjson are counted too.
+#include "statistics.hpp"
+#include <cstdlib>
+#include <new>
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    scribe::statistics().heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    scribe::statistics().heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    scribe::statistics().heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+}
+
+// Route operator new through the wrapped malloc so that it is counted exactly once.
+void *operator new(size_t size) {
+    void *ptr = std::malloc(size ? size : 1);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
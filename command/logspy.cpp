@@ -5,27 +5,55 @@
 
 #include "stream.hpp"
 #include "utils.hpp"
+#include "memory.hpp"
 #include "params.hpp"
 #include "policies.hpp"
 #include "report.hpp"
+#include "statistics.hpp"
 #include "utils/timer.hpp"
 
 int main(int argc, char *argv[]) {
     auto params = scribe::parse_input_arguments(argc, argv);
 	utils::ElapsedTime<utils::SECOND> timer("Total runtime: ", params.timer());
-	if (params.report()) {
-		scribe::strip_scribe_headers<scribe::ReportPolicy>(params);
-	} else if (params.table()) {
-		scribe::strip_scribe_headers<scribe::CSVPolicy>(params);
-	} else if (params.raw()) {
-		scribe::strip_scribe_headers<scribe::RawPolicy>(params);
-	} else if (params.json_output()) {
-		scribe::strip_scribe_headers<scribe::CompactJsonPolicy>(params);
-	} else if (params.json_compact_output()) {
-		scribe::strip_scribe_headers<scribe::CompactJsonPolicy>(params);
-	} else if (params.json_pretty_output()) {
-		scribe::strip_scribe_headers<scribe::PrettyJsonPolicy>(params);
-	} else {					// Generate the report by default.
-		scribe::strip_scribe_headers<scribe::ReportPolicy>(params);
+	try {
+		if (params.report()) {
+			scribe::strip_scribe_headers<scribe::ReportPolicy>(params);
+		} else if (params.table()) {
+			scribe::strip_scribe_headers<scribe::CSVPolicy>(params);
+		} else if (params.raw()) {
+			scribe::strip_scribe_headers<scribe::RawPolicy>(params);
+		} else if (params.json_output()) {
+			scribe::strip_scribe_headers<scribe::CompactJsonPolicy>(params);
+		} else if (params.json_compact_output()) {
+			scribe::strip_scribe_headers<scribe::CompactJsonPolicy>(params);
+		} else if (params.json_pretty_output()) {
+			scribe::strip_scribe_headers<scribe::PrettyJsonPolicy>(params);
+		} else {					// Generate the report by default.
+			scribe::strip_scribe_headers<scribe::ReportPolicy>(params);
+		}
+	} catch (const std::exception &error) {
+		fmt::print(stderr, "{0}\n", error.what());
+		return EXIT_FAILURE;
 	}
+
+	// Heap allocations made by the line arena should stay flat once it is warmed up.
+	// Only output policies which parse JSON data create the arena.
+	const auto arena = scribe::current_thread_arena();
+	if (params.timer() && (arena != nullptr)) {
+		fmt::print(stderr, "Arena: {0} heap allocations, {1} resets, {2} bytes reserved\n",
+				   arena->allocations(), arena->resets(), arena->capacity());
+	}
+
+#ifdef SCRIBE_ALLOCATION_COUNTER
+	// Every heap allocation made by the process is counted in benchmark builds.
+	const auto &stats = scribe::statistics();
+	const size_t steady_lines = stats.steady_state_lines();
+	fmt::print(stderr,
+			   "Heap allocations: {0} in total, {1} during warm up, {2} for {3} lines in steady "
+			   "state ({4:.6f} per line)\n",
+			   stats.heap_allocations.load(), stats.warmup_allocations,
+			   stats.steady_state_allocations(), steady_lines,
+			   steady_lines ? static_cast<double>(stats.steady_state_allocations()) / steady_lines
+							: 0.0);
+#endif
 }
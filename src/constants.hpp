@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstddef>
+
 namespace scribe {
 	constexpr char EOL = '\n';
 	constexpr char OPEN_CURLY_BRACE = '{';
+	constexpr size_t DEFAULT_GROUP_WINDOW = 1000;
 }
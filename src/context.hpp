@@ -0,0 +1,279 @@
+#pragma once
+
+#include "fmt/format.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+
+namespace scribe {
+    // A line and the location of its group key. The key offset is relative to begin so it
+    // stays valid when the line is copied, and an empty key means the line has no key. Keys
+    // are only extracted when they are needed, i.e has_key is false until then.
+    struct LineView {
+        const char *begin = nullptr;
+        size_t len = 0;
+        size_t line = 0;
+        size_t key_offset = 0;
+        size_t key_len = 0;
+        bool has_key = false;
+    };
+
+    // The minimum size of the blocks which keep detached lines.
+    constexpr size_t LINE_BLOCK_SIZE = 1 << 16;
+
+    // A fixed size ring of recent lines. Lines are stored as views into the read buffer and
+    // are only copied by detach() when the read buffer is about to be reused, so lines which
+    // are pushed out of the ring within a batch are never copied.
+    class LineRing {
+      public:
+        explicit LineRing(const size_t capacity = 0) : views(capacity) {}
+
+        size_t capacity() const { return views.size(); }
+        size_t size() const { return count; }
+
+        void push(const char *begin, const size_t len, const size_t line) {
+            push(LineView{begin, len, line, 0, 0, false});
+        }
+
+        void push(const LineView &view) {
+            if (views.empty()) return;
+            views[head] = view;
+            head = (head + 1) % views.size();
+            if (count < views.size()) ++count;
+            if (pending < views.size()) ++pending;
+        }
+
+        // Visit lines from the oldest to the newest one. A visitor can drop a line, i.e once
+        // it has been printed, by setting its length to zero.
+        template <typename Visitor> void visit(Visitor &&visitor) {
+            visit(count, std::forward<Visitor>(visitor));
+        }
+
+        void clear() {
+            head = 0;
+            count = 0;
+            pending = 0;
+            while (!blocks.empty()) release_block();
+        }
+
+        // Copy lines which have been pushed since the last call, i.e lines which still point
+        // into the read buffer, to our own storage. Adjacent lines are copied by a single
+        // memcpy, and blocks are recycled once none of their lines are left in the ring, so
+        // each line is copied at most once.
+        void detach() {
+            if (pending == 0) return;
+            const size_t number_of_lines = pending;
+            pending = 0;
+            release_unused_blocks();
+
+            size_t required = 0;
+            visit(number_of_lines, [&required](LineView &view) { required += view.len; });
+            if (required == 0) return;
+
+            std::vector<char> &block = get_block(required);
+            const char *run_begin = nullptr;
+            const char *run_end = nullptr;
+            visit(number_of_lines, [&block, &run_begin, &run_end](LineView &view) {
+                if (view.begin != run_end) {
+                    block.insert(block.end(), run_begin, run_end);
+                    run_begin = view.begin;
+                }
+                run_end = view.begin + view.len;
+                view.begin = block.data() + block.size() + (view.begin - run_begin);
+            });
+            block.insert(block.end(), run_begin, run_end);
+        }
+
+      private:
+        std::vector<LineView> views;
+        size_t head = 0;
+        size_t count = 0;
+        size_t pending = 0; // The number of newest lines which have not been detached.
+        std::deque<std::vector<char>> blocks;
+        std::vector<std::vector<char>> spare_blocks;
+
+        // Visit the newest number_of_lines lines.
+        template <typename Visitor>
+        void visit(const size_t number_of_lines, Visitor &&visitor) {
+            if (number_of_lines == 0) return;
+            const size_t size = views.size();
+            for (size_t n = 0, idx = (head + size - number_of_lines) % size;
+                 n < number_of_lines; ++n, idx = (idx + 1) % size) {
+                if (views[idx].len > 0) visitor(views[idx]);
+            }
+        }
+
+        // Blocks are ordered in the same way as lines, so a block can be released once the
+        // oldest line in the ring is not in it.
+        void release_unused_blocks() {
+            const char *oldest = nullptr;
+            const size_t size = views.size();
+            for (size_t n = 0, idx = (head + size - count) % size; n < count;
+                 ++n, idx = (idx + 1) % size) {
+                if (views[idx].len > 0) {
+                    oldest = views[idx].begin;
+                    break;
+                }
+            }
+            while (!blocks.empty() && !is_stored(blocks.front(), oldest)) release_block();
+        }
+
+        static bool is_stored(const std::vector<char> &block, const char *ptr) {
+            return (ptr >= block.data()) && (ptr < block.data() + block.size());
+        }
+
+        void release_block() {
+            spare_blocks.push_back(std::move(blocks.front()));
+            blocks.pop_front();
+        }
+
+        // Return a block which can take required bytes without being reallocated.
+        std::vector<char> &get_block(const size_t required) {
+            if (!blocks.empty() &&
+                (blocks.back().capacity() - blocks.back().size() >= required)) {
+                return blocks.back();
+            }
+            if (spare_blocks.empty()) {
+                blocks.emplace_back();
+            } else {
+                blocks.push_back(std::move(spare_blocks.back()));
+                spare_blocks.pop_back();
+            }
+            blocks.back().clear();
+            blocks.back().reserve(std::max(required, LINE_BLOCK_SIZE));
+            return blocks.back();
+        }
+    };
+
+    // Active groups ordered by their expiry line. Expiry lines never decrease, so refreshing a
+    // group moves it to the back and expired groups are always at the front.
+    class GroupTable {
+      public:
+        bool empty() const { return groups.empty(); }
+        size_t size() const { return groups.size(); }
+
+        bool contains(const char *key, const size_t len) const {
+            return lookup_table.find(fmt::string_view(key, len)) != lookup_table.end();
+        }
+
+        void insert(const char *key, const size_t len, const size_t expiry) {
+            auto iter = lookup_table.find(fmt::string_view(key, len));
+            if (iter != lookup_table.end()) {
+                iter->second->expiry = expiry;
+                groups.splice(groups.end(), groups, iter->second);
+                return;
+            }
+            groups.push_back(Group{std::string(key, len), expiry});
+            auto last = std::prev(groups.end());
+            lookup_table.emplace(fmt::string_view(last->key), last);
+        }
+
+        // Drop groups which expired before a given line.
+        void expire(const size_t line) {
+            while (!groups.empty() && (groups.front().expiry < line)) {
+                lookup_table.erase(fmt::string_view(groups.front().key));
+                groups.pop_front();
+            }
+        }
+
+        void clear() {
+            lookup_table.clear();
+            groups.clear();
+        }
+
+      private:
+        struct Group {
+            std::string key;
+            size_t expiry;
+        };
+
+        // Keys of the lookup table point to strings in list nodes which never move.
+        std::list<Group> groups;
+        std::unordered_map<fmt::string_view, std::list<Group>::iterator, StringViewHash>
+            lookup_table;
+    };
+
+    // Return the closing quote of a JSON string which starts at begin, or end if the string is
+    // not terminated. Escaped quotes are skipped.
+    inline const char *skip_json_string(const char *begin, const char *end) {
+        const char *ptr = begin;
+        while ((ptr = static_cast<const char *>(std::memchr(ptr, '"', end - ptr)))) {
+            const char *escape = ptr;
+            while ((escape > begin) && (*(escape - 1) == '\\')) --escape;
+            if (((ptr - escape) % 2) == 0) return ptr;
+            ++ptr;
+        }
+        return end;
+    }
+
+    // Extract the string value of a top level field, i.e "PREFIX":"value", from a JSON log
+    // message without parsing the whole message. The scribe header before the first '{' and
+    // nested objects are skipped. The value is returned as is, i.e escape sequences are not
+    // decoded. Return false if the field is missing or its value is not a string.
+    inline bool find_json_field(const char *begin, const size_t len, const std::string &key,
+                                const char *&value, size_t &value_len) {
+        const char *end = begin + len;
+        const char *ptr = static_cast<const char *>(std::memchr(begin, '{', len));
+        if (ptr == nullptr) return false;
+
+        int depth = 0;
+        bool expect_key = false;
+        for (; ptr < end; ++ptr) {
+            switch (*ptr) {
+            case '{':
+                expect_key = (++depth == 1);
+                break;
+            case '[':
+                ++depth;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0) return false;
+                break;
+            case ',':
+                expect_key = (depth == 1);
+                break;
+            case '"': {
+                const char *str = ptr + 1;
+                const char *stop = skip_json_string(str, end);
+                if (stop == end) return false;
+                ptr = stop;
+                if (!expect_key) break;
+
+                // Move to the value of a top level key.
+                expect_key = false;
+                const bool is_matched = (static_cast<size_t>(stop - str) == key.size()) &&
+                                        (std::memcmp(str, key.data(), key.size()) == 0);
+                ++ptr;
+                while ((ptr < end) && std::isspace(static_cast<unsigned char>(*ptr))) ++ptr;
+                if ((ptr == end) || (*ptr != ':')) return false;
+                ++ptr;
+                while ((ptr < end) && std::isspace(static_cast<unsigned char>(*ptr))) ++ptr;
+                if (ptr == end) return false;
+                if (is_matched) {
+                    if (*ptr != '"') return false;
+                    value = ptr + 1;
+                    stop = skip_json_string(value, end);
+                    if (stop == end) return false;
+                    value_len = stop - value;
+                    return true;
+                }
+                --ptr; // Let the loop process the value.
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        return false;
+    }
+} // namespace scribe
@@ -5,67 +5,83 @@
 #include "rapidjson/prettywriter.h"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
+#include <cstring>
 #include <string>
 
+#include "memory.hpp"
+#include "utils.hpp"
+
 namespace scribe {
-    struct CompactJsonPolicy {
-        template <typename Params>
-        CompactJsonPolicy(Params &&params) : silent(params.silent()), linebuf() {}
+    constexpr size_t JSON_STACK_CAPACITY = 1024;
 
-        void operator()(const char *begin, const size_t len) {
-            linebuf.clear();
-            linebuf.append(begin, len);
-            char *data = const_cast<char *>(linebuf.data());
+    // A rapidjson allocator which takes memory from the thread arena. The same allocator
+    // is reused by every document and the memory is released when the arena is reset at
+    // the end of a batch, so parsing a line does not allocate in steady state.
+    class JsonAllocator {
+      public:
+        static const bool kNeedFree = false;
 
-            // Parse given JSON string
-            rapidjson::Document document;
-            if (document.ParseInsitu(data).HasParseError()) {
-                fmt::print(stderr, "Cannot parse given string: \033[1;32m{0}\033[0m\n",
-                           std::string(begin, len));
-                return;
-            }
+        JsonAllocator() : arena(&thread_arena()) {}
 
-            // Print out results in the compact JSON format.
-            if (!silent) {
-                rapidjson::StringBuffer sb;
-                rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-                document.Accept(writer);
-                fmt::print("{0}\n", sb.GetString());
-            }
+        void *Malloc(size_t size) { return size ? arena->allocate(size) : nullptr; }
+        void *Realloc(void *ptr, size_t old_size, size_t new_size) {
+            if (new_size == 0) return nullptr;
+            return arena->reallocate(ptr, old_size, new_size);
         }
+        static void Free(void *) {}
 
-        bool silent = false;
-        std::string linebuf;
+        Arena &get_arena() { return *arena; }
+
+      private:
+        Arena *arena;
     };
 
-    struct PrettyJsonPolicy {
+    using JsonValue = rapidjson::GenericValue<rapidjson::UTF8<>, JsonAllocator>;
+    using JsonDocument =
+        rapidjson::GenericDocument<rapidjson::UTF8<>, JsonAllocator, JsonAllocator>;
+
+    // Copy a line into the arena and parse it in place. Both the document and the copy are
+    // valid until the arena is reset.
+    inline bool parse_json(JsonDocument &document, Arena &arena, const char *begin,
+                           const size_t len) {
+        char *data = static_cast<char *>(arena.allocate(len + 1));
+        std::memcpy(data, begin, len);
+        data[len] = 0;
+        return !document.ParseInsitu(data).HasParseError();
+    }
+
+    template <typename Writer> class JsonPolicy {
+      public:
         template <typename Params>
-        PrettyJsonPolicy(Params &&params) : silent(params.silent()), linebuf() {}
+        JsonPolicy(Params &&params)
+            : silent(params.silent()), allocator(), buffer(), writer(buffer) {}
 
         void operator()(const char *begin, const size_t len) {
-            linebuf.clear();
-            linebuf.append(begin, len);
-            char *data = const_cast<char *>(linebuf.data());
-
             // Parse given JSON string
-            rapidjson::Document document;
-            if (document.ParseInsitu(data).HasParseError()) {
+            JsonDocument document(&allocator, JSON_STACK_CAPACITY, &allocator);
+            if (!parse_json(document, allocator.get_arena(), begin, len)) {
                 fmt::print(stderr, "Cannot parse given string: \033[1;32m{0}\033[0m\n",
-                           std::string(begin, len));
+                           fmt::string_view(begin, len));
                 return;
             }
 
-            // Print out results in the compact JSON format.
+            // Print out results. The buffer and the writer keep their capacity across lines.
             if (!silent) {
-                rapidjson::StringBuffer sb;
-                rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
+                buffer.Clear();
+                writer.Reset(buffer);
                 document.Accept(writer);
-                fmt::print("{0}\n", sb.GetString());
+                buffer.Put('\n');
+                print_plain_text(buffer.GetString(), buffer.GetString() + buffer.GetSize());
             }
         }
 
+      private:
         bool silent = false;
-        std::string linebuf;
+        JsonAllocator allocator;
+        rapidjson::StringBuffer buffer;
+        Writer writer;
     };
 
+    using CompactJsonPolicy = JsonPolicy<rapidjson::Writer<rapidjson::StringBuffer>>;
+    using PrettyJsonPolicy = JsonPolicy<rapidjson::PrettyWriter<rapidjson::StringBuffer>>;
 } // namespace scribe
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace scribe {
+    // A bump allocator for short lived per-line data. Memory is handed out from a single
+    // block and released all at once by reset(). Requests which do not fit are served by
+    // overflow blocks, and reset() folds the peak usage into a bigger block so a steady
+    // stream of similar batches does not touch the heap at all.
+    class Arena {
+      public:
+        static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+        static constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+
+        explicit Arena(const size_t capacity = DEFAULT_CAPACITY) { reserve(capacity); }
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        ~Arena() {
+            release_overflow();
+            std::free(buffer);
+        }
+
+        void *allocate(size_t size) {
+            size = align(size);
+            if (size <= current_capacity - offset) {
+                last = buffer + offset;
+                offset += size;
+                return last;
+            }
+
+            // Serve the request from an overflow block.
+            void *ptr = std::malloc(size);
+            if (ptr == nullptr) throw std::bad_alloc();
+            overflow.push_back(ptr);
+            overflow_size += size;
+            ++number_of_allocations;
+            last = nullptr;
+            return ptr;
+        }
+
+        // Grow the last allocation in place if possible, otherwise copy it to a new block.
+        void *reallocate(void *ptr, const size_t old_size, const size_t new_size) {
+            if (ptr == nullptr) return allocate(new_size);
+            if (ptr == last) {
+                const size_t start = last - buffer;
+                const size_t size = align(new_size);
+                if (size <= current_capacity - start) {
+                    offset = start + size;
+                    return ptr;
+                }
+            }
+            void *results = allocate(new_size);
+            std::memcpy(results, ptr, std::min(old_size, new_size));
+            return results;
+        }
+
+        // Release all memory handed out since the last reset.
+        void reset() {
+            if (!overflow.empty()) {
+                // Allocate the new block first so a failure leaves the arena intact.
+                const size_t peak = offset + overflow_size;
+                char *old_buffer = buffer;
+                reserve(std::max(peak, 2 * current_capacity));
+                std::free(old_buffer);
+                release_overflow();
+            }
+            offset = 0;
+            last = nullptr;
+            ++number_of_resets;
+        }
+
+        size_t capacity() const { return current_capacity; }
+        size_t size() const { return offset + overflow_size; }
+        size_t allocations() const { return number_of_allocations; }
+        size_t resets() const { return number_of_resets; }
+
+      private:
+        char *buffer = nullptr;
+        char *last = nullptr;
+        size_t offset = 0;
+        size_t current_capacity = 0;
+        std::vector<void *> overflow;
+        size_t overflow_size = 0;
+        size_t number_of_allocations = 0;
+        size_t number_of_resets = 0;
+
+        static size_t align(const size_t size) {
+            return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        }
+
+        // Replace the block. The arena is left unchanged if the allocation fails.
+        void reserve(const size_t capacity) {
+            const size_t size = align(capacity);
+            char *ptr = static_cast<char *>(std::malloc(size));
+            if (ptr == nullptr) throw std::bad_alloc();
+            buffer = ptr;
+            current_capacity = size;
+            ++number_of_allocations;
+        }
+
+        void release_overflow() {
+            for (auto ptr : overflow) std::free(ptr);
+            overflow.clear();
+            overflow_size = 0;
+        }
+    };
+
+    inline std::unique_ptr<Arena> &thread_arena_storage() {
+        thread_local std::unique_ptr<Arena> arena;
+        return arena;
+    }
+
+    // Each reader thread owns one arena which is shared by its stream and output policies.
+    // The arena is only created by output policies which need scratch memory.
+    inline Arena &thread_arena() {
+        auto &arena = thread_arena_storage();
+        if (!arena) arena.reset(new Arena());
+        return *arena;
+    }
+
+    // Return the arena of the current thread, or nullptr if it has not been created.
+    inline Arena *current_thread_arena() { return thread_arena_storage().get(); }
+} // namespace scribe
@@ -1,12 +1,16 @@
 #pragma once
 
+#include "clara.hpp"
 #include "constants.hpp"
-#include "utils/matchers.hpp"
-#include "utils/matchers_avx2.hpp"
-#include "utils/regex_matchers.hpp"
+#include "fmt/format.h"
+#include "search.hpp"
 
 #include "ioutils/reader.hpp"
 #include "ioutils/stream.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace scribe {
     enum PARAMS : int32_t {
@@ -32,6 +36,14 @@ namespace scribe {
         std::string pattern;
         std::string output_file;
 
+        // Context lines printed around each match.
+        size_t before_context = 0;
+        size_t after_context = 0;
+
+        // Collect lines which share the same value of this JSON field with matched lines.
+        std::string group_by;
+        size_t group_window = DEFAULT_GROUP_WINDOW;
+
         bool verbose() const { return (info & VERBOSE) > 0; }
         bool color() const { return (info & COLOR) > 0; }
         bool exact_match() const { return (info & EXACT_MATCH) > 0; }
@@ -45,40 +57,37 @@ namespace scribe {
         bool table() const { return (info & TABLE) > 0; }
         bool report() const { return (info & REPORT) > 0; }
         bool timer() const { return (info & TIMER) > 0; }
+        bool has_context() const {
+            return (before_context > 0) || (after_context > 0) || !group_by.empty();
+        }
+    };
+
+    // Params which carry the compiled pattern, so all readers share the matcher used by the
+    // search library.
+    struct CompiledParams : public Params {
+        CompiledParams(const Params &params, const Pattern &pattern)
+            : Params(params), pattern(pattern) {}
+        const Pattern &pattern;
     };
 
-    template <typename Reader> void extract(const Params &params) {
+    template <typename Reader, typename ReaderParams> void extract(const ReaderParams &params) {
         Reader reader(params);
-        for (auto const &afile : params.paths) { reader(afile.data()); }
+        for (auto const &afile : params.paths) {
+            reader(afile.data());
+            reader.finish();
+        }
     }
 
     template <typename OutputPolicy> void strip_scribe_headers(const Params &params) {
-        if (params.pattern.empty()) {
-            using Policy = scribe::StreamPolicy<scribe::All, OutputPolicy>;
-            using Reader = ioutils::FileReader<Policy>;
-            extract<Reader>(params);
-        } else {
-            if (params.exact_match()) {
-                using Policy = scribe::StreamPolicy<utils::ExactMatchAVX2, OutputPolicy>;
-                using Reader = ioutils::FileReader<Policy>;
-                extract<Reader>(params);
-            } else {
-                if (!params.inverse_match()) {
-                    using Matcher = utils::hyperscan::RegexMatcher;
-                    using Policy = scribe::StreamPolicy<Matcher, OutputPolicy>;
-                    using Reader = ioutils::FileReader<Policy>;
-                    extract<Reader>(params);
-                } else {
-                    using Matcher = utils::hyperscan::RegexMatcherInv;
-                    using Policy = scribe::StreamPolicy<Matcher, OutputPolicy>;
-                    using Reader = ioutils::FileReader<Policy>;
-                    extract<Reader>(params);
-                }
-            }
-        }
+        const unsigned int options = params.exact_match() * PATTERN_EXACT_MATCH |
+                                     params.inverse_match() * PATTERN_INVERSE_MATCH;
+        const Pattern pattern(params.pattern, params.regex_mode, options);
+        using Policy = scribe::StreamPolicy<PatternMatcher, ConsoleOutput<OutputPolicy>>;
+        using Reader = ioutils::FileReader<Policy>;
+        extract<Reader>(CompiledParams(params, pattern));
     }
 
-    Params parse_input_arguments(int argc, char *argv[]) {
+    inline Params parse_input_arguments(int argc, char *argv[]) {
         Params params;
 
         // Input argument
@@ -103,6 +112,8 @@ namespace scribe {
 
         bool timer = false; // Display execution time.
 
+        size_t context = 0; // The number of context lines printed before and after a match.
+
         auto cli =
             clara::Help(help) |
             clara::Opt(verbose)["-v"]["--verbose"]("Display verbose information") |
@@ -125,6 +136,19 @@ namespace scribe {
             clara::Opt(params.output_file,
                        "output")["-o"]["--output"]("The output file name.") |
             clara::Opt(params.pattern, "pattern")["-e"]["-p"]["--pattern"]("Search pattern.") |
+            clara::Opt(params.after_context, "num")["-A"]["--after-context"](
+                "Print num lines of trailing context after matched lines.") |
+            clara::Opt(params.before_context, "num")["-B"]["--before-context"](
+                "Print num lines of leading context before matched lines.") |
+            clara::Opt(context, "num")["-C"]["--context"](
+                "Print num lines of leading and trailing context.") |
+            clara::Opt(params.group_by, "field")["--group-by"](
+                "Print all lines which share the value of a given top level JSON field, i.e "
+                "PREFIX, with matched lines.") |
+            clara::Opt(params.group_window, "num")["--group-window"](
+                "The number of lines searched before and after a match for --group-by. "
+                "These lines are copied when the read buffer is reused, so a large window "
+                "slows down the search.") |
 
             // Required arguments.
             clara::Arg(params.paths, "paths")("Search paths");
@@ -143,6 +167,34 @@ namespace scribe {
             exit(EXIT_SUCCESS);
         }
 
+        // Explicit -A and -B options take precedence over -C.
+        if (params.after_context == 0) params.after_context = context;
+        if (params.before_context == 0) params.before_context = context;
+
+        // Use the same rules as the search library for context lines and grouped lines.
+        try {
+            SearchOptions options;
+            options.before_context = params.before_context;
+            options.after_context = params.after_context;
+            options.group_by = params.group_by;
+            options.group_window = params.group_window;
+            check_search_options(options);
+        } catch (const std::invalid_argument &error) {
+            fmt::print(stderr, "Invalid option: {}\n", error.what());
+            exit(EXIT_FAILURE);
+        }
+
+        // Reports and tables summarize messages so they cannot show context lines. Print raw
+        // messages by default if context lines are requested.
+        if (params.has_context()) {
+            if (report || table) {
+                fmt::print(stderr, "Invalid option: -A, -B, -C and --group-by cannot be used "
+                                   "with --report or --table.\n");
+                exit(EXIT_FAILURE);
+            }
+            if (!json_output && !json_compact_output && !json_pretty_output) raw = true;
+        }
+
         // Update search parameters
         params.regex_mode =
             HS_FLAG_DOTALL | HS_FLAG_SINGLEMATCH | (ignore_case ? HS_FLAG_CASELESS : 0);
@@ -175,10 +227,13 @@ namespace fmt {
                 "Search pattern: {0}\nInput options:\n\tregex_mode: "
                 "{1}\n\tverbose: {2}\n\tcolor: "
                 "{3}\n\tinverse_match: {4}\n\texact_match: {5}\n\tjson: "
-                "{6}\n\tcompact-json: {7}\n\tpretty-json: {8}\n\tsilent: {9}\n\tstdin: {10}\n\ttimer: {11}\n",
+                "{6}\n\tcompact-json: {7}\n\tpretty-json: {8}\n\tsilent: {9}\n\tstdin: {10}\n\ttimer: {11}\n"
+                "\tbefore-context: {12}\n\tafter-context: {13}\n\tgroup-by: {14}\n"
+                "\tgroup-window: {15}\n",
                 p.pattern, p.regex_mode, p.verbose(), p.color(), p.inverse_match(),
                 p.exact_match(), p.json_output(), p.json_compact_output(),
-                p.json_pretty_output(), p.silent(), p.stdin(), p.timer());
+                p.json_pretty_output(), p.silent(), p.stdin(), p.timer(), p.before_context,
+                p.after_context, p.group_by, p.group_window);
         }
     };
 } // namespace fmt
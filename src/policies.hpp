@@ -1,6 +1,7 @@
 #pragma once
 
 #include "fmt/format.h"
+#include <cstdio>
 #include <cstring>
 #include <string>
 
@@ -8,25 +9,113 @@
 #include "json.hpp"
 #include "report.hpp"
 #include "sqlite.hpp"
+#include "utils.hpp"
 
 namespace scribe {
+    enum MessageKind : int {
+        MATCHED_MESSAGE = 0,
+        CONTEXT_MESSAGE = 1, // Lines printed before or after a match, i.e -A and -B.
+        GROUP_MESSAGE = 2,   // Lines which share the group key of a match, i.e --group-by.
+        INVALID_MESSAGE = 3, // Lines which do not have any JSON data.
+    };
+
+    // Where a message comes from. Both file indexes and line numbers are per input.
+    struct MessageInfo {
+        MessageKind kind;
+        size_t file;
+        size_t line;
+    };
+
     class RawPolicy {
       public:
         template <typename Params>
-        RawPolicy(Params &&params) : silent(params.silent()), color(params.color()) {}
-        void operator()(const char *begin, const size_t len) {
-            if (!silent) {
-                if (!color) {
-                    fmt::print("{0}", std::string(begin, len));
-                } else {
-                    fmt::print("\033[1;32m{0}\033[0m", std::string(begin, len));
+        RawPolicy(Params &&params)
+            : silent(params.silent()), color(params.color()),
+              separator((params.before_context > 0) || (params.after_context > 0) ||
+                        !params.group_by.empty()) {}
+        void operator()(const char *begin, const size_t len) { print(begin, len, color); }
+
+        // Print messages like grep does: only matched lines are highlighted, and blocks of
+        // context or group lines which are not adjacent are separated by "--".
+        void operator()(const char *begin, const size_t len, const MessageInfo &info) {
+            if (silent) return;
+            if (separator) {
+                if (has_printed && ((info.file != last_file) || (info.line != last_line + 1))) {
+                    fputs("--\n", stdout);
                 }
+                has_printed = true;
+                last_file = info.file;
+                last_line = info.line;
             }
+            print(begin, len, color && (info.kind == MATCHED_MESSAGE));
         }
 
       private:
         bool silent = false;
         bool color = false;
+        bool separator = false;
+        bool has_printed = false;
+        size_t last_file = 0;
+        size_t last_line = 0;
+
+        void print(const char *begin, const size_t len, const bool highlight) {
+            if (!silent) {
+                if (!highlight) {
+                    print_plain_text(begin, begin + len);
+                } else {
+                    print_color_text(begin, begin + len);
+                }
+            }
+        }
+    };
+
+    // Output policies print all messages in the same way unless they know message kinds.
+    template <typename Policy>
+    void print_message(Policy &policy, const char *begin, const size_t len,
+                       const MessageInfo &) {
+        policy(begin, len);
+    }
+
+    inline void print_message(RawPolicy &policy, const char *begin, const size_t len,
+                              const MessageInfo &info) {
+        policy(begin, len, info);
+    }
+
+    // Adapt a logspy output policy to the stream policy, which passes the message info along
+    // with each message. Invalid log messages are reported to stderr.
+    template <typename Policy> class ConsoleOutput : public Policy {
+      public:
+        using Policy::Policy;
+        bool operator()(const char *begin, const size_t len, const MessageInfo &info) {
+            if (info.kind == INVALID_MESSAGE) {
+                fmt::print(stderr, "Invalid log message: {0} -> {1}\n",
+                           fmt::string_view(begin, len), len);
+            } else {
+                print_message(static_cast<Policy &>(*this), begin, len, info);
+            }
+            return true;
+        }
+    };
+
+    // Receive a message. The message points into the search buffer so it is only valid during
+    // the call. Return a non-zero value to stop the search.
+    using MatchCallback = int (*)(const char *begin, size_t len, const MessageInfo &info,
+                                  void *user_data);
+
+    class CallbackPolicy {
+      public:
+        template <typename Params>
+        CallbackPolicy(Params &&params)
+            : callback(params.callback), user_data(params.user_data) {}
+
+        // Return false if the callback wants to stop the search.
+        bool operator()(const char *begin, const size_t len, const MessageInfo &info) {
+            return callback(begin, len, info, user_data) == 0;
+        }
+
+      private:
+        MatchCallback callback = nullptr;
+        void *user_data = nullptr;
     };
 
 	struct StorePolicy {
@@ -2,10 +2,17 @@
 
 #include "fmt/format.h"
 #include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include <algorithm>
 #include <cstring>
 #include <limits>
 #include <unordered_map>
+#include <vector>
 
+#include "json.hpp"
+#include "memory.hpp"
+#include "utils.hpp"
 #include "utils/timestamp.hpp"
 
 // TODO: Need to have a graph for job status.
@@ -33,9 +40,12 @@ namespace scribe {
 
     class ReportPolicy {
       public:
+        static constexpr size_t KEY_STORAGE_CAPACITY = 1 << 16;
+
         template <typename Params>
         ReportPolicy(Params &&params)
-            : silent(params.silent()), verbose(params.verbose()), linebuf() {}
+            : silent(params.silent()), verbose(params.verbose()), allocator(), buffer(),
+              writer(buffer), key_storage(KEY_STORAGE_CAPACITY) {}
 
         ~ReportPolicy() {
             // Sort results
@@ -50,7 +60,8 @@ namespace scribe {
         }
 
         void print() const {
-            auto print_obj = [](const std::string &title, auto table, const bool verbose) {
+            auto print_obj = [](const std::string &title, const Keys &table,
+                                const bool verbose) {
                 fmt::print("\033[1;35m{0}\033[0m: {1}\n", title, table.size());
                 if (verbose) {
                     for (auto &item : table) {
@@ -68,24 +79,20 @@ namespace scribe {
 
         void operator()(const char *begin, const size_t len) {
             if (len == 0) return;
-            linebuf.clear();
-            linebuf.append(begin, len);
-            char *data = const_cast<char *>(linebuf.data());
 
-            rapidjson::Document document;
-            if (document.ParseInsitu(data).HasParseError()) {
+            JsonDocument document(&allocator, JSON_STACK_CAPACITY, &allocator);
+            if (!parse_json(document, allocator.get_arena(), begin, len)) {
                 fmt::print(stderr, "Cannot parse given string: \033[1;32m{0}\033[0m\n",
-                           std::string(begin, len));
+                           fmt::string_view(begin, len));
                 return;
             }
 
             // Process parsed JSON data
             if (document.HasMember("PREFIX")) {
-                std::string prefix = document["PREFIX"].GetString();
-                std::string level = document["LEVEL"].GetString();
                 JobInfo info;
 
-                if (prefix.empty()) return; // Skip if we cannot get the message id.
+                // Skip if we cannot get the message id.
+                if (document["PREFIX"].GetStringLength() == 0) return;
 
                 if (document.HasMember("MESSAGE")) {
                     // Below are possible types of messages
@@ -100,109 +107,92 @@ namespace scribe {
 
                 } else if (document.HasMember("REQUEST")) {
                     if (document.HasMember("RESOURCENAME")) {
-                        std::string resource_name = document["RESOURCENAME"].GetString();
-                        auto iter = resource_lookup_table.find(resource_name);
-                        if (iter == resource_lookup_table.end()) {
-                            info.resource = resources.size();
-                            resources.push_back(resource_name);
-                            resource_lookup_table.emplace(resource_name, info.resource);
-                        } else {
-                            info.resource = iter->second;
-                        }
+                        info.resource = lookup(document["RESOURCENAME"],
+                                               resource_lookup_table, resources);
                     }
 
                     // Extract job information.
-                    if (document["REQUEST"].HasMember("JOB")) {
-                        std::string job = document["REQUEST"]["JOB"].GetString();
-                        auto iter = job_lookup_table.find(job);
-                        if (iter == job_lookup_table.end()) {
-                            info.job = jobs.size();
-                            jobs.push_back(job);
-                            job_lookup_table.emplace(job, info.job);
-                        } else {
-                            info.job = iter->second;
-                        }
+                    const JsonValue &request = document["REQUEST"];
+                    if (request.HasMember("JOB")) {
+                        info.job = lookup(request["JOB"], job_lookup_table, jobs);
                     }
 
                     // Extrace DB schema
-                    if (document["REQUEST"].HasMember("SCHEMA")) {
-                        std::string key = document["REQUEST"]["SCHEMA"].GetString();
-                        auto iter = schema_lookup_table.find(key);
-                        if (iter == schema_lookup_table.end()) {
-                            info.schema = schemas.size();
-                            schemas.push_back(key);
-                            schema_lookup_table.emplace(key, info.schema);
-                        } else {
-                            info.schema = iter->second;
-                        }
+                    if (request.HasMember("SCHEMA")) {
+                        info.schema = lookup(request["SCHEMA"], schema_lookup_table, schemas);
                     }
 
                     // Extract pool information.
-                    if (document["REQUEST"].HasMember("POOL")) {
-                        std::string key = document["REQUEST"]["POOL"].GetString();
-                        auto iter = pool_lookup_table.find(key);
-                        if (iter == pool_lookup_table.end()) {
-                            info.pool = pools.size();
-                            pools.push_back(key);
-                            pool_lookup_table.emplace(key, info.pool);
-                        } else {
-                            info.pool = iter->second;
-                        }
+                    if (request.HasMember("POOL")) {
+                        info.pool = lookup(request["POOL"], pool_lookup_table, pools);
                     }
 
                     // Extract instance information.
-                    if (document["REQUEST"].HasMember("INSTANCE")) {
-                        std::string key = document["REQUEST"]["INSTANCE"].GetString();
-                        auto iter = instance_lookup_table.find(key);
-                        if (iter == instance_lookup_table.end()) {
-                            info.instance = instances.size();
-                            instances.push_back(key);
-                            instance_lookup_table.emplace(key, info.instance);
-                        } else {
-                            info.instance = iter->second;
-                        }
+                    if (request.HasMember("INSTANCE")) {
+                        info.instance =
+                            lookup(request["INSTANCE"], instance_lookup_table, instances);
                     }
 
                 } else if (document.HasMember("RAW_ERROR")) {
-                    rapidjson::StringBuffer sb;
-                    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
-                    document.Accept(writer);
-                    fmt::print("{0}\n", sb.GetString());
+                    print_json("", document);
                 } else {
-
-                    rapidjson::StringBuffer sb;
-                    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
-                    document.Accept(writer);
-                    fmt::print("Unrecognized JSON structure: {0}\n", sb.GetString());
+                    print_json("Unrecognized JSON structure: ", document);
                 }
             } else {
-                rapidjson::StringBuffer sb;
-                rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
-                document.Accept(writer);
-                fmt::print("Invalid JSON structure: {0}\n", sb.GetString());
+                print_json("Invalid JSON structure: ", document);
             }
         }
 
       private:
+        using LookupTable = std::unordered_map<fmt::string_view, unsigned int, StringViewHash>;
+        using Keys = std::vector<fmt::string_view>;
+
         bool silent = false;
         bool verbose = false;
-        std::string linebuf;
+        JsonAllocator allocator;
+        rapidjson::StringBuffer buffer;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer;
+
+        // Storage for unique keys. It is never reset so keys stay valid until we are done.
+        Arena key_storage;
 
         std::unordered_map<std::string, JobInfo> status; // Hold status of a current job
 
-        std::unordered_map<std::string, unsigned int> job_lookup_table;
-        std::vector<std::string> jobs;
+        LookupTable job_lookup_table;
+        Keys jobs;
 
-        std::unordered_map<std::string, unsigned int> resource_lookup_table;
-        std::vector<std::string> resources;
+        LookupTable resource_lookup_table;
+        Keys resources;
 
-        std::unordered_map<std::string, unsigned int> pool_lookup_table;
-        std::vector<std::string> pools;
+        LookupTable pool_lookup_table;
+        Keys pools;
 
-        std::unordered_map<std::string, unsigned int> schema_lookup_table;
-        std::vector<std::string> schemas;
+        LookupTable schema_lookup_table;
+        Keys schemas;
 
-        std::unordered_map<std::string, unsigned int> instance_lookup_table;
-        std::vector<std::string> instances;
+        LookupTable instance_lookup_table;
+        Keys instances;
+
+        // Return the index of a given key. The key is only copied the first time we see it.
+        unsigned int lookup(const JsonValue &value, LookupTable &table, Keys &keys) {
+            fmt::string_view key(value.GetString(), value.GetStringLength());
+            auto iter = table.find(key);
+            if (iter != table.end()) return iter->second;
+            char *data = static_cast<char *>(key_storage.allocate(key.size()));
+            std::memcpy(data, key.data(), key.size());
+            const unsigned int idx = keys.size();
+            keys.emplace_back(data, key.size());
+            table.emplace(keys.back(), idx);
+            return idx;
+        }
+
+        void print_json(const char *title, const JsonDocument &document) {
+            buffer.Clear();
+            writer.Reset(buffer);
+            document.Accept(writer);
+            buffer.Put('\n');
+            fputs(title, stdout);
+            print_plain_text(buffer.GetString(), buffer.GetString() + buffer.GetSize());
+        }
     };
 } // namespace scribe
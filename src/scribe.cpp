@@ -0,0 +1,152 @@
+#include "scribe.h"
+#include "search.hpp"
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct scribe_pattern {
+    scribe_pattern(const std::string &pattern, const int regex_mode, const unsigned int options)
+        : pattern(pattern, regex_mode, options) {}
+    scribe::Pattern pattern;
+};
+
+static_assert(SCRIBE_MATCHED_MESSAGE == static_cast<int>(scribe::MATCHED_MESSAGE),
+              "Invalid message kind");
+static_assert(SCRIBE_CONTEXT_MESSAGE == static_cast<int>(scribe::CONTEXT_MESSAGE),
+              "Invalid message kind");
+static_assert(SCRIBE_GROUP_MESSAGE == static_cast<int>(scribe::GROUP_MESSAGE),
+              "Invalid message kind");
+static_assert(SCRIBE_INVALID_MESSAGE == static_cast<int>(scribe::INVALID_MESSAGE),
+              "Invalid message kind");
+
+namespace {
+    thread_local std::string last_error;
+
+    int set_error(const int code, const char *msg) {
+        last_error = msg;
+        return code;
+    }
+
+    // Only read the fields which are covered by struct_size.
+    template <typename T>
+    bool has_field(const scribe_search_options *options, const size_t offset) {
+        return options->struct_size >= offset + sizeof(T);
+    }
+
+    scribe::SearchOptions get_search_options(const scribe_search_options *options) {
+        scribe::SearchOptions results;
+        if (options == nullptr) return results;
+        if (options->struct_size < sizeof(size_t)) {
+            throw std::invalid_argument("struct_size of scribe_search_options is not set.");
+        }
+        if (has_field<size_t>(options, offsetof(scribe_search_options, before_context))) {
+            results.before_context = options->before_context;
+        }
+        if (has_field<size_t>(options, offsetof(scribe_search_options, after_context))) {
+            results.after_context = options->after_context;
+        }
+        if (has_field<const char *>(options, offsetof(scribe_search_options, group_by)) &&
+            (options->group_by != nullptr)) {
+            results.group_by = options->group_by;
+        }
+        if (has_field<size_t>(options, offsetof(scribe_search_options, group_window)) &&
+            (options->group_window > 0)) {
+            results.group_window = options->group_window;
+        }
+        return results;
+    }
+
+    // Forward messages from the C++ search API to a C callback.
+    struct CallbackContext {
+        scribe_match_callback callback;
+        void *user_data;
+    };
+
+    int forward_match(const char *begin, size_t len, const scribe::MessageInfo &info,
+                      void *user_data) {
+        auto context = static_cast<const CallbackContext *>(user_data);
+        const scribe_match match{info.kind, info.file, info.line, begin, len};
+        return context->callback(&match, context->user_data);
+    }
+
+    // Do not let exceptions escape through the C interface.
+    template <typename Func> int call(Func &&func) {
+        try {
+            return func() ? SCRIBE_SUCCESS : SCRIBE_STOPPED;
+        } catch (const std::bad_alloc &) {
+            return set_error(SCRIBE_ERROR, "Out of memory.");
+        } catch (const std::invalid_argument &error) {
+            return set_error(SCRIBE_INVALID_ARGUMENT, error.what());
+        } catch (const std::exception &error) {
+            return set_error(SCRIBE_ERROR, error.what());
+        } catch (...) {
+            return set_error(SCRIBE_ERROR, "Unknown error.");
+        }
+    }
+} // namespace
+
+extern "C" {
+void scribe_search_options_init(scribe_search_options *options) {
+    if (options == nullptr) return;
+    options->struct_size = sizeof(scribe_search_options);
+    options->before_context = 0;
+    options->after_context = 0;
+    options->group_by = nullptr;
+    options->group_window = scribe::DEFAULT_GROUP_WINDOW;
+}
+
+int scribe_pattern_compile(const char *pattern, unsigned int flags, scribe_pattern **results) {
+    if ((pattern == nullptr) || (results == nullptr)) {
+        return set_error(SCRIBE_INVALID_ARGUMENT, "Invalid argument.");
+    }
+
+    const int regex_mode =
+        scribe::DEFAULT_REGEX_MODE | ((flags & SCRIBE_IGNORE_CASE) ? HS_FLAG_CASELESS : 0);
+    const unsigned int options =
+        ((flags & SCRIBE_EXACT_MATCH) ? scribe::PATTERN_EXACT_MATCH : 0) |
+        ((flags & SCRIBE_INVERSE_MATCH) ? scribe::PATTERN_INVERSE_MATCH : 0);
+    try {
+        *results = new scribe_pattern(pattern, regex_mode, options);
+    } catch (const std::bad_alloc &) {
+        return set_error(SCRIBE_ERROR, "Out of memory.");
+    } catch (const std::exception &error) {
+        return set_error(SCRIBE_COMPILE_ERROR, error.what());
+    }
+    return SCRIBE_SUCCESS;
+}
+
+void scribe_pattern_free(scribe_pattern *pattern) { delete pattern; }
+
+int scribe_search_buffer(const scribe_pattern *pattern, const scribe_search_options *options,
+                         const char *buffer, size_t len, scribe_match_callback callback,
+                         void *user_data) {
+    if ((pattern == nullptr) || (callback == nullptr) || ((buffer == nullptr) && (len > 0))) {
+        return set_error(SCRIBE_INVALID_ARGUMENT, "Invalid argument.");
+    }
+    CallbackContext context{callback, user_data};
+    return call([&]() {
+        return scribe::search(pattern->pattern, get_search_options(options), buffer, len,
+                              forward_match, &context);
+    });
+}
+
+int scribe_search_files(const scribe_pattern *pattern, const scribe_search_options *options,
+                        const char *const *paths, size_t number_of_paths,
+                        scribe_match_callback callback, void *user_data) {
+    if ((pattern == nullptr) || (callback == nullptr) ||
+        ((paths == nullptr) && (number_of_paths > 0))) {
+        return set_error(SCRIBE_INVALID_ARGUMENT, "Invalid argument.");
+    }
+    CallbackContext context{callback, user_data};
+    return call([&]() {
+        std::vector<std::string> files(paths, paths + number_of_paths);
+        return scribe::search(pattern->pattern, get_search_options(options), files,
+                              forward_match, &context);
+    });
+}
+
+const char *scribe_last_error(void) { return last_error.c_str(); }
+}
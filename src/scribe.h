@@ -0,0 +1,85 @@
+#ifndef SCRIBE_H
+#define SCRIBE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Return codes. */
+enum {
+    SCRIBE_SUCCESS = 0,
+    SCRIBE_INVALID_ARGUMENT = 1,
+    SCRIBE_COMPILE_ERROR = 2,
+    SCRIBE_ERROR = 3,
+    SCRIBE_STOPPED = 4, /* The callback stopped the search. */
+};
+
+/* Pattern flags. */
+enum {
+    SCRIBE_IGNORE_CASE = 1,
+    SCRIBE_EXACT_MATCH = 1 << 1,
+    SCRIBE_INVERSE_MATCH = 1 << 2,
+};
+
+/* Kinds of messages passed to the callback. */
+enum {
+    SCRIBE_MATCHED_MESSAGE = 0,
+    SCRIBE_CONTEXT_MESSAGE = 1, /* A line before or after a match. */
+    SCRIBE_GROUP_MESSAGE = 2,   /* A line which shares the group key of a match. */
+    SCRIBE_INVALID_MESSAGE = 3, /* A line without JSON data. The message is the whole line. */
+};
+
+/* A compiled pattern. It can be shared by concurrent searches. */
+typedef struct scribe_pattern scribe_pattern;
+
+/* A message found by a search. The message points into the search buffer and is only valid
+ * during the call. */
+typedef struct scribe_match {
+    int kind;            /* One of the SCRIBE_*_MESSAGE values. */
+    size_t file;         /* The index of the file in the path list, 0 for buffers. */
+    size_t line;         /* The line number in the file or buffer, starting from 1. */
+    const char *message; /* The JSON part of the line including its newline, if any. */
+    size_t len;
+} scribe_match;
+
+/* Receive a message. Return a non-zero value to stop the search. */
+typedef int (*scribe_match_callback)(const scribe_match *match, void *user_data);
+
+/* Search options. Callers must set struct_size, i.e using scribe_search_options_init, so new
+ * fields can be added without breaking existing callers. A NULL pointer means no context lines
+ * and no grouping. group_by cannot be combined with context lines. */
+typedef struct scribe_search_options {
+    size_t struct_size;    /* sizeof(scribe_search_options) */
+    size_t before_context; /* Lines printed before a match. */
+    size_t after_context;  /* Lines printed after a match. */
+    const char *group_by;  /* Collect lines sharing this top level JSON field, or NULL. */
+    size_t group_window;   /* Lines searched around a match for group_by, 0 for default. */
+} scribe_search_options;
+
+/* Set struct_size and the default values of all options. */
+void scribe_search_options_init(scribe_search_options *options);
+
+/* Compile a pattern. An empty pattern matches all lines. */
+int scribe_pattern_compile(const char *pattern, unsigned int flags, scribe_pattern **results);
+void scribe_pattern_free(scribe_pattern *pattern);
+
+/* Search a buffer of newline separated log messages. */
+int scribe_search_buffer(const scribe_pattern *pattern, const scribe_search_options *options,
+                         const char *buffer, size_t len, scribe_match_callback callback,
+                         void *user_data);
+
+/* Search a list of log files. */
+int scribe_search_files(const scribe_pattern *pattern, const scribe_search_options *options,
+                        const char *const *paths, size_t number_of_paths,
+                        scribe_match_callback callback, void *user_data);
+
+/* The error message of the last failed call in the current thread. */
+const char *scribe_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
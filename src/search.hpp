@@ -0,0 +1,232 @@
+#pragma once
+
+#include "fmt/format.h"
+#include "hs/hs.h"
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "constants.hpp"
+#include "policies.hpp"
+#include "stream.hpp"
+
+namespace scribe {
+    constexpr int DEFAULT_REGEX_MODE = HS_FLAG_DOTALL | HS_FLAG_SINGLEMATCH;
+    constexpr size_t READ_BUFFER_SIZE = 1 << 16;
+
+    enum PatternOptions : unsigned int {
+        PATTERN_EXACT_MATCH = 1,
+        PATTERN_INVERSE_MATCH = 1 << 1,
+    };
+
+    // A compiled search pattern. A pattern is immutable once it is compiled so it can be
+    // shared by concurrent searches, each of which clones its own scratch space.
+    class Pattern {
+      public:
+        explicit Pattern(const std::string &pattern, const int regex_mode = DEFAULT_REGEX_MODE,
+                         const unsigned int options = 0)
+            : inverse((options & PATTERN_INVERSE_MATCH) > 0) {
+            if (pattern.empty()) return; // An empty pattern matches all lines.
+
+            const std::string expr =
+                (options & PATTERN_EXACT_MATCH) ? escape(pattern) : pattern;
+            hs_compile_error_t *error = nullptr;
+            if (hs_compile(expr.c_str(), regex_mode, HS_MODE_BLOCK, nullptr, &database,
+                           &error) != HS_SUCCESS) {
+                const std::string msg =
+                    fmt::format("Cannot compile pattern \"{0}\": {1}", pattern, error->message);
+                hs_free_compile_error(error);
+                throw std::runtime_error(msg);
+            }
+
+            if (hs_alloc_scratch(database, &scratch) != HS_SUCCESS) {
+                hs_free_database(database);
+                throw std::runtime_error("Cannot allocate the scratch space for hyperscan.");
+            }
+        }
+
+        Pattern(const Pattern &) = delete;
+        Pattern &operator=(const Pattern &) = delete;
+
+        ~Pattern() {
+            hs_free_scratch(scratch);
+            hs_free_database(database);
+        }
+
+      private:
+        friend class PatternMatcher;
+        hs_database_t *database = nullptr;
+        hs_scratch_t *scratch = nullptr; // The prototype of per search scratch spaces.
+        bool inverse = false;
+
+        // Exact matching is done by escaping every non alphanumeric character.
+        static std::string escape(const std::string &pattern) {
+            std::string results;
+            results.reserve(2 * pattern.size());
+            for (auto const ch : pattern) {
+                if (!std::isalnum(static_cast<unsigned char>(ch))) results.push_back('\\');
+                results.push_back(ch);
+            }
+            return results;
+        }
+    };
+
+    // A matcher which scans lines using a shared compiled pattern.
+    class PatternMatcher {
+      public:
+        PatternMatcher(const Pattern &pattern, const int)
+            : database(pattern.database), inverse(pattern.inverse) {
+            if ((database != nullptr) &&
+                (hs_clone_scratch(pattern.scratch, &scratch) != HS_SUCCESS)) {
+                throw std::runtime_error("Cannot allocate the scratch space for hyperscan.");
+            }
+        }
+
+        PatternMatcher(const PatternMatcher &) = delete;
+        PatternMatcher &operator=(const PatternMatcher &) = delete;
+
+        ~PatternMatcher() { hs_free_scratch(scratch); }
+
+        bool is_matched(const char *begin, const size_t len) {
+            if (database == nullptr) return !inverse;
+            bool matched = false;
+            const hs_error_t status =
+                hs_scan(database, begin, len, 0, scratch, on_match, &matched);
+            if ((status != HS_SUCCESS) && (status != HS_SCAN_TERMINATED)) {
+                throw std::runtime_error(
+                    fmt::format("Cannot scan the input data: hyperscan error {0}.", status));
+            }
+            return matched != inverse;
+        }
+
+      private:
+        const hs_database_t *database = nullptr;
+        hs_scratch_t *scratch = nullptr;
+        bool inverse = false;
+
+        static int on_match(unsigned int, unsigned long long, unsigned long long, unsigned int,
+                            void *context) {
+            *static_cast<bool *>(context) = true;
+            return 1; // Stop at the first match.
+        }
+    };
+
+    struct SearchOptions {
+        size_t before_context = 0;
+        size_t after_context = 0;
+        std::string group_by;
+        size_t group_window = DEFAULT_GROUP_WINDOW;
+    };
+
+    // Search parameters which are passed to the stream and output policies.
+    struct SearchParams {
+        SearchParams(const Pattern &pattern, const SearchOptions &options,
+                     MatchCallback callback, void *user_data)
+            : pattern(pattern), before_context(options.before_context),
+              after_context(options.after_context), group_by(options.group_by),
+              group_window(options.group_window), callback(callback), user_data(user_data) {}
+
+        const Pattern &pattern;
+        int regex_mode = DEFAULT_REGEX_MODE;
+        size_t before_context;
+        size_t after_context;
+        const std::string &group_by;
+        size_t group_window;
+        MatchCallback callback;
+        void *user_data;
+
+        bool verbose() const { return false; }
+        bool color() const { return false; }
+        bool silent() const { return false; }
+    };
+
+    using SearchPolicy = StreamPolicy<PatternMatcher, CallbackPolicy>;
+
+    // Context lines and grouped lines cannot be combined. Both logspy and libscribe use these
+    // rules.
+    inline void check_search_options(const SearchOptions &options) {
+        if (options.group_by.empty()) return;
+        if ((options.before_context > 0) || (options.after_context > 0)) {
+            throw std::invalid_argument("group-by cannot be used with context lines.");
+        }
+        if (options.group_window == 0) {
+            throw std::invalid_argument("group-window must be positive.");
+        }
+    }
+
+    // Search a buffer of log messages. This function is reentrant, and messages are passed to
+    // the callback without being copied. Return false if the callback stopped the search.
+    inline bool search(const Pattern &pattern, const SearchOptions &options,
+                       const char *buffer, const size_t len, MatchCallback callback,
+                       void *user_data) {
+        check_search_options(options);
+        SearchParams params(pattern, options, callback, user_data);
+        SearchPolicy policy(params);
+        policy.process(buffer, len);
+        policy.finish();
+        return !policy.stopped();
+    }
+
+    // Close a file descriptor when it goes out of scope, so the search does not leak it when
+    // the policy throws.
+    class FileDescriptor {
+      public:
+        explicit FileDescriptor(const int fd) : fd(fd) {}
+        FileDescriptor(const FileDescriptor &) = delete;
+        FileDescriptor &operator=(const FileDescriptor &) = delete;
+        ~FileDescriptor() {
+            if (fd >= 0) ::close(fd);
+        }
+        int get() const { return fd; }
+
+      private:
+        int fd;
+    };
+
+    // Read a file in blocks and stop reading as soon as the search is stopped.
+    inline void search_file(SearchPolicy &policy, const std::string &path, char *buffer,
+                            const size_t buffer_size) {
+        const FileDescriptor fd(::open(path.data(), O_RDONLY));
+        if (fd.get() < 0) {
+            throw std::runtime_error(
+                fmt::format("Cannot open file \"{0}\": {1}", path, std::strerror(errno)));
+        }
+
+        while (!policy.stopped()) {
+            const ssize_t nbytes = ::read(fd.get(), buffer, buffer_size);
+            if (nbytes > 0) {
+                policy.process(buffer, nbytes);
+            } else if (nbytes == 0) {
+                break;
+            } else if (errno != EINTR) {
+                throw std::runtime_error(
+                    fmt::format("Cannot read file \"{0}\": {1}", path, std::strerror(errno)));
+            }
+        }
+
+        policy.finish();
+    }
+
+    // Search a list of log files. Each file is searched independently, and the file index of
+    // a message is the position of its file in the list. Return false if the callback stopped
+    // the search.
+    inline bool search(const Pattern &pattern, const SearchOptions &options,
+                       const std::vector<std::string> &paths, MatchCallback callback,
+                       void *user_data) {
+        check_search_options(options);
+        SearchParams params(pattern, options, callback, user_data);
+        SearchPolicy policy(params);
+        std::unique_ptr<char[]> buffer(new char[READ_BUFFER_SIZE]);
+        for (auto const &afile : paths) {
+            search_file(policy, afile, buffer.get(), READ_BUFFER_SIZE);
+            if (policy.stopped()) return false;
+        }
+        return true;
+    }
+} // namespace scribe
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace scribe {
+    // Heap allocation statistics for benchmark builds, i.e logspy is built with
+    // SCRIBE_ALLOCATION_COUNTER. Allocations made until the end of the first batch of lines
+    // are warm up, everything after that up to the end of the last batch is steady state.
+    struct Statistics {
+        std::atomic<size_t> heap_allocations{0};
+        size_t lines = 0;
+        size_t batches = 0;
+        size_t warmup_allocations = 0;
+        size_t warmup_lines = 0;
+        size_t last_batch_allocations = 0;
+
+        void end_batch(const size_t number_of_lines) {
+            const size_t allocations = heap_allocations.load(std::memory_order_relaxed);
+            lines += number_of_lines;
+            if (batches++ == 0) {
+                warmup_allocations = allocations;
+                warmup_lines = lines;
+            }
+            last_batch_allocations = allocations;
+        }
+
+        size_t steady_state_allocations() const {
+            return last_batch_allocations - warmup_allocations;
+        }
+        size_t steady_state_lines() const { return lines - warmup_lines; }
+    };
+
+    inline Statistics &statistics() {
+        static Statistics stats;
+        return stats;
+    }
+} // namespace scribe
@@ -1,29 +1,54 @@
 #pragma once
 
 #include "constants.hpp"
+#include "context.hpp"
 #include "fmt/format.h"
+#include "memory.hpp"
+#include "statistics.hpp"
 #include "utils.hpp"
 #include "utils/memchr.hpp"
 #include <cstring>
 #include <string>
 
-
 #include "policies.hpp"
 
 namespace scribe {
-    template <typename Matcher, typename OutputPolicy = RawPolicy> class StreamPolicy {
+    template <typename Matcher, typename OutputPolicy = ConsoleOutput<RawPolicy>>
+    class StreamPolicy {
       public:
         template <typename Params>
         StreamPolicy(Params &&params)
             : matcher(params.pattern, params.regex_mode), lines(1), pos(0), linebuf(),
-              output(std::forward<Params>(params)) {
+              output(std::forward<Params>(params)), after_context(params.after_context),
+              group_by(params.group_by), group_window(params.group_window),
+              recent_lines(group_by.empty() ? params.before_context : params.group_window) {
             color = params.color();
             verbose = params.verbose();
+            use_context = (after_context > 0) || (recent_lines.capacity() > 0);
         }
 
         ~StreamPolicy() { process_linebuf(); }
 
+        // Flush the last line of the current input and get ready for the next one, so
+        // neither partial lines nor context lines are carried over from one file to another.
+        void finish() {
+            process_linebuf();
+            linebuf.clear();
+            recent_lines.clear();
+            remaining_after_context = 0;
+            groups.clear();
+            lines = 1;
+            pos = 0;
+            ++file;
+        }
+
+        // Return true if the output policy has stopped the search.
+        bool stopped() const { return is_stopped; }
+
         void process(const char *begin, const size_t len) {
+#ifdef SCRIBE_ALLOCATION_COUNTER
+            const size_t batch_start = lines;
+#endif
             const char *start = begin;
             const char *end = begin + len;
             const char *ptr = begin;
@@ -34,6 +59,7 @@ namespace scribe {
                 } else {
                     linebuf.append(start, ptr - start + 1);
                     process_linebuf();
+                    if (use_context) recent_lines.detach();
                     linebuf.clear();
                 }
 
@@ -41,48 +67,143 @@ namespace scribe {
                 start = ++ptr;
                 ++lines;
 
-                // Stop if we reach the end of the buffer.
-                if (start == end) break;
+                // Stop if we reach the end of the buffer or the output policy asks us to.
+                if ((start == end) || is_stopped) break;
             }
 
+            // Keep context lines alive when the read buffer is reused.
+            if (use_context) recent_lines.detach();
+
             // Update the line buffer with leftover data.
             if (ptr == nullptr) { linebuf.append(start, end - start); }
             pos += len;
+
+            // Release scratch memory used by output policies for this batch of lines.
+            if (auto arena = current_thread_arena()) arena->reset();
+
+#ifdef SCRIBE_ALLOCATION_COUNTER
+            statistics().end_batch(lines - batch_start);
+#endif
         }
 
       private:
         Matcher matcher;
         size_t lines = 1;
         size_t pos = 0;
+        size_t file = 0;
+        bool is_stopped = false;
         std::string linebuf;
         OutputPolicy output;
         bool verbose = false;
         bool color = false;
 
+        // Context lines and grouped lines.
+        bool use_context = false;
+        size_t after_context = 0;
+        size_t remaining_after_context = 0;
+        std::string group_by;
+        size_t group_window = 0;
+        GroupTable groups;
+        LineRing recent_lines;
+
       protected:
         void process_line(const char *begin, const size_t len) {
-            if ((len > 0) && matcher.is_matched(begin, len)) {
-                auto end = begin + len;
-
-                // Extract the scribe header by finding the start of JSON text data.
-                const char *ptr = static_cast<const char *>(
-                    utils::avx2::memchr(begin, OPEN_CURLY_BRACE, len));
-                if (ptr != nullptr) {
-                    output(ptr, end - ptr);
+            if ((len == 0) || is_stopped) return;
+            if (matcher.is_matched(begin, len)) {
+                if (use_context) {
+                    process_matched_context(begin, len);
                 } else {
-                    // TODO: What should we do with the invalid log messages?
-                    fmt::print(stderr, "Invalid log message: {0} -> {1}\n",
-                               std::string(begin, begin + len), len);
+                    print_line(begin, len, MATCHED_MESSAGE, lines);
+                }
+            } else if (use_context) {
+                process_unmatched_context(begin, len);
+            }
+        }
+
+        void print_line(const char *begin, const size_t len, const MessageKind kind,
+                        const size_t line) {
+            if (is_stopped) return;
+            auto end = begin + len;
+
+            // Extract the scribe header by finding the start of JSON text data.
+            const char *ptr =
+                static_cast<const char *>(utils::avx2::memchr(begin, OPEN_CURLY_BRACE, len));
+            if (ptr != nullptr) {
+                is_stopped = !output(ptr, end - ptr, MessageInfo{kind, file, line});
+            } else {
+                // Let the output policy decide what to do with lines without JSON data.
+                is_stopped = !output(begin, len, MessageInfo{INVALID_MESSAGE, file, line});
+            }
+        }
+
+        // Print the matched line together with its leading context, i.e recent lines for
+        // -B or recent lines which share the same group key for --group-by.
+        void process_matched_context(const char *begin, const size_t len) {
+            if (group_by.empty()) {
+                recent_lines.visit([this](LineView &view) {
+                    print_line(view.begin, view.len, CONTEXT_MESSAGE, view.line);
+                    view.len = 0;
+                });
+                remaining_after_context = after_context;
+            } else {
+                const char *key = nullptr;
+                size_t key_len = 0;
+                if (find_json_field(begin, len, group_by, key, key_len) && (key_len > 0)) {
+                    recent_lines.visit([this, key, key_len](LineView &view) {
+                        if (!view.has_key) extract_key(view);
+                        if ((view.key_len == key_len) &&
+                            (std::memcmp(view.begin + view.key_offset, key, key_len) == 0)) {
+                            print_line(view.begin, view.len, GROUP_MESSAGE, view.line);
+                            view.len = 0;
+                        }
+                    });
+
+                    // Keep collecting lines of this group for group_window lines.
+                    groups.insert(key, key_len, lines + group_window);
                 }
             }
+            print_line(begin, len, MATCHED_MESSAGE, lines);
+        }
+
+        void process_unmatched_context(const char *begin, const size_t len) {
+            if (group_by.empty()) {
+                if (remaining_after_context > 0) {
+                    print_line(begin, len, CONTEXT_MESSAGE, lines);
+                    --remaining_after_context;
+                    return;
+                }
+                recent_lines.push(begin, len, lines);
+                return;
+            }
+
+            // Lines are only scanned for their group keys while there are active groups. Other
+            // lines are scanned when a match needs them, and at most once.
+            if (!groups.empty()) groups.expire(lines);
+            if (groups.empty()) {
+                recent_lines.push(begin, len, lines);
+                return;
+            }
+
+            LineView view{begin, len, lines, 0, 0, false};
+            extract_key(view);
+            if ((view.key_len > 0) && groups.contains(begin + view.key_offset, view.key_len)) {
+                print_line(begin, len, GROUP_MESSAGE, lines);
+                return;
+            }
+            recent_lines.push(view);
+        }
+
+        void extract_key(LineView &view) const {
+            const char *key = nullptr;
+            size_t key_len = 0;
+            if (find_json_field(view.begin, view.len, group_by, key, key_len)) {
+                view.key_offset = key - view.begin;
+                view.key_len = key_len;
+            }
+            view.has_key = true;
         }
 
         // Process text data in the linebuf.
         void process_linebuf() { process_line(linebuf.data(), linebuf.size()); }
     };
-
-    struct All {
-        All(const std::string &, int) {}
-        bool is_matched(const char *, const size_t) { return true; }
-    };
 } // namespace scribe
@@ -5,14 +5,29 @@
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/prettywriter.h" // for stringify JSON
+#include <cstdint>
 #include <cstdio>
 
 namespace scribe {
-    void print_color_text(const char *begin, const char *end) {
-        fmt::print("\033[1;32m{0}\033[0m", std::string(begin, end - begin));
+    inline void print_color_text(const char *begin, const char *end) {
+        fputs("\033[1;32m", stdout);
+        fwrite(begin, 1, end - begin, stdout);
+        fputs("\033[0m", stdout);
     }
 
-    void print_plain_text(const char *begin, const char *end) {
-        fmt::print("{0}", std::string(begin, end - begin));
+    // Write text straight to stdout so large lines do not go through a temporary buffer.
+    inline void print_plain_text(const char *begin, const char *end) {
+        fwrite(begin, 1, end - begin, stdout);
     }
+
+    // FNV-1a hash for string keys which are not owned by their lookup tables.
+    struct StringViewHash {
+        size_t operator()(const fmt::string_view &key) const {
+            uint64_t hash = 14695981039346656037ULL;
+            for (auto ptr = key.data(), end = key.data() + key.size(); ptr != end; ++ptr) {
+                hash = (hash ^ static_cast<unsigned char>(*ptr)) * 1099511628211ULL;
+            }
+            return static_cast<size_t>(hash);
+        }
+    };
 } // namespace scribe
@@ -0,0 +1,137 @@
+#include "context.hpp"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+namespace {
+    std::vector<std::string> collect(scribe::LineRing &ring) {
+        std::vector<std::string> results;
+        ring.visit([&results](scribe::LineView &view) {
+            results.emplace_back(view.begin, view.len);
+        });
+        return results;
+    }
+} // namespace
+
+TEST(LineRing, Push) {
+    scribe::LineRing ring(2);
+    const std::string data("a\nb\nc\n");
+    ring.push(data.data(), 2, 1);
+    ring.push(data.data() + 2, 2, 2);
+    ring.push(data.data() + 4, 2, 3);
+    EXPECT_EQ(ring.size(), 2u);
+    EXPECT_EQ(collect(ring), (std::vector<std::string>{"b\n", "c\n"}));
+
+    // Dropped lines are skipped.
+    ring.visit([](scribe::LineView &view) {
+        if (view.line == 2) view.len = 0;
+    });
+    EXPECT_EQ(collect(ring), (std::vector<std::string>{"c\n"}));
+
+    ring.clear();
+    EXPECT_EQ(ring.size(), 0u);
+    EXPECT_TRUE(collect(ring).empty());
+}
+
+TEST(LineRing, Empty) {
+    scribe::LineRing ring;
+    const std::string data("a\n");
+    ring.push(data.data(), data.size(), 1);
+    ring.detach();
+    EXPECT_EQ(ring.capacity(), 0u);
+    EXPECT_TRUE(collect(ring).empty());
+}
+
+TEST(LineRing, DetachBufferReuse) {
+    scribe::LineRing ring(3);
+    std::string buffer("line 1\nline 2\n");
+    ring.push(buffer.data(), 7, 1);
+    ring.push(buffer.data() + 7, 7, 2);
+    ring.detach();
+
+    // Lines must survive when the read buffer is overwritten.
+    buffer.assign("LINE 3\nLINE 4\n");
+    ring.push(buffer.data(), 7, 3);
+    EXPECT_EQ(collect(ring), (std::vector<std::string>{"line 1\n", "line 2\n", "LINE 3\n"}));
+
+    ring.detach();
+    buffer.assign("xxxxxxxxxxxxxx");
+    EXPECT_EQ(collect(ring), (std::vector<std::string>{"line 1\n", "line 2\n", "LINE 3\n"}));
+}
+
+TEST(LineRing, DetachBlockReuse) {
+    scribe::LineRing ring(2);
+    std::string buffer;
+    std::vector<std::string> expected;
+
+    // Push many batches so storage blocks are released and reused several times.
+    for (size_t batch = 0; batch < 100; ++batch) {
+        buffer = "batch " + std::to_string(batch) + " first\n" + "batch " +
+                 std::to_string(batch) + " second\n";
+        const size_t first = buffer.find('\n') + 1;
+        ring.push(buffer.data(), first, 2 * batch + 1);
+        ring.push(buffer.data() + first, buffer.size() - first, 2 * batch + 2);
+
+        // Drop a line to make sure dropped lines are not copied.
+        if ((batch % 3) == 0) {
+            ring.visit([batch](scribe::LineView &view) {
+                if (view.line == 2 * batch + 1) view.len = 0;
+            });
+        }
+        ring.detach();
+
+        expected.clear();
+        if ((batch % 3) != 0) expected.push_back(buffer.substr(0, first));
+        expected.push_back(buffer.substr(first));
+        buffer.assign(buffer.size(), '-');
+        EXPECT_EQ(collect(ring), expected);
+    }
+}
+
+TEST(GroupTable, Expire) {
+    scribe::GroupTable groups;
+    const std::string key1("abc"), key2("xyz");
+    groups.insert(key1.data(), key1.size(), 10);
+    groups.insert(key2.data(), key2.size(), 12);
+    EXPECT_EQ(groups.size(), 2u);
+    EXPECT_TRUE(groups.contains("abc", 3));
+    EXPECT_FALSE(groups.contains("ab", 2));
+
+    // A group is active up to its expiry line.
+    groups.expire(10);
+    EXPECT_TRUE(groups.contains("abc", 3));
+    groups.expire(11);
+    EXPECT_FALSE(groups.contains("abc", 3));
+    EXPECT_TRUE(groups.contains("xyz", 3));
+
+    // Refreshing a group extends its expiry line. Expiry lines never decrease.
+    groups.insert(key1.data(), key1.size(), 15);
+    groups.insert(key2.data(), key2.size(), 20);
+    groups.expire(16);
+    EXPECT_EQ(groups.size(), 1u);
+    EXPECT_TRUE(groups.contains("xyz", 3));
+    groups.expire(21);
+    EXPECT_TRUE(groups.empty());
+}
+
+TEST(FindJsonField, TopLevelFields) {
+    auto find = [](const std::string &line, const std::string &key) {
+        const char *value = nullptr;
+        size_t len = 0;
+        if (!scribe::find_json_field(line.data(), line.size(), key, value, len)) {
+            return std::string("<none>");
+        }
+        return std::string(value, len);
+    };
+
+    EXPECT_EQ(find("header {\"PREFIX\":\"abc\",\"x\":1}\n", "PREFIX"), "abc");
+    EXPECT_EQ(find("header { \"x\" : 1 , \"PREFIX\" : \"abc\" }\n", "PREFIX"), "abc");
+    EXPECT_EQ(find("{\"inner\":{\"PREFIX\":\"no\"},\"PREFIX\":\"yes\"}", "PREFIX"), "yes");
+    EXPECT_EQ(find("{\"a\":[{\"PREFIX\":\"no\"}],\"PREFIX\":\"yes\"}", "PREFIX"), "yes");
+    EXPECT_EQ(find("{\"a\":\"PREFIX\",\"PREFIX\":\"yes\"}", "PREFIX"), "yes");
+    EXPECT_EQ(find("{\"PREFIX\":\"a\\\"b\"}", "PREFIX"), "a\\\"b");
+    EXPECT_EQ(find("{\"a\\\"PREFIX\":\"no\"}", "PREFIX"), "<none>");
+    EXPECT_EQ(find("{\"inner\":{\"PREFIX\":\"no\"}}", "PREFIX"), "<none>");
+    EXPECT_EQ(find("{\"PREFIX\":1}", "PREFIX"), "<none>");
+    EXPECT_EQ(find("no json data", "PREFIX"), "<none>");
+}
@@ -0,0 +1,167 @@
+#include "gtest/gtest.h"
+#include "scribe.h"
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    struct Results {
+        std::vector<scribe_match> matches;
+        std::vector<std::string> messages;
+        size_t max_matches = 0; // Stop the search after max_matches if it is positive.
+    };
+
+    int collect(const scribe_match *match, void *user_data) {
+        auto results = static_cast<Results *>(user_data);
+        results->matches.push_back(*match);
+        results->messages.emplace_back(match->message, match->len);
+        return (results->max_matches > 0) && (results->matches.size() >= results->max_matches);
+    }
+
+    scribe_pattern *compile(const char *pattern, const unsigned int flags = 0) {
+        scribe_pattern *results = nullptr;
+        EXPECT_EQ(scribe_pattern_compile(pattern, flags, &results), SCRIBE_SUCCESS)
+            << scribe_last_error();
+        return results;
+    }
+
+    const std::string log_data = "h {\"id\":1}\n"
+                                 "h {\"id\":2,\"msg\":\"error\"}\n"
+                                 "h {\"id\":3}\n"
+                                 "h {\"id\":4,\"msg\":\"ERROR\"}";
+} // namespace
+
+TEST(SearchBuffer, NoTrailingNewline) {
+    auto pattern = compile("error", SCRIBE_IGNORE_CASE);
+    Results results;
+    EXPECT_EQ(scribe_search_buffer(pattern, nullptr, log_data.data(), log_data.size(), collect,
+                                   &results),
+              SCRIBE_SUCCESS);
+    EXPECT_EQ(results.messages, (std::vector<std::string>{"{\"id\":2,\"msg\":\"error\"}\n",
+                                                          "{\"id\":4,\"msg\":\"ERROR\"}"}));
+    ASSERT_EQ(results.matches.size(), 2u);
+    EXPECT_EQ(results.matches[0].kind, SCRIBE_MATCHED_MESSAGE);
+    EXPECT_EQ(results.matches[0].line, 2u);
+    EXPECT_EQ(results.matches[1].line, 4u);
+    scribe_pattern_free(pattern);
+}
+
+TEST(SearchBuffer, Context) {
+    auto pattern = compile("error");
+    scribe_search_options options;
+    scribe_search_options_init(&options);
+    options.before_context = 1;
+    Results results;
+    EXPECT_EQ(scribe_search_buffer(pattern, &options, log_data.data(), log_data.size(),
+                                   collect, &results),
+              SCRIBE_SUCCESS);
+    ASSERT_EQ(results.matches.size(), 2u);
+    EXPECT_EQ(results.matches[0].kind, SCRIBE_CONTEXT_MESSAGE);
+    EXPECT_EQ(results.matches[0].line, 1u);
+    EXPECT_EQ(results.matches[1].kind, SCRIBE_MATCHED_MESSAGE);
+    EXPECT_EQ(results.matches[1].line, 2u);
+
+    // Options which cannot be combined are rejected.
+    options.group_by = "id";
+    EXPECT_EQ(scribe_search_buffer(pattern, &options, log_data.data(), log_data.size(),
+                                   collect, &results),
+              SCRIBE_INVALID_ARGUMENT);
+    EXPECT_STRNE(scribe_last_error(), "");
+    scribe_pattern_free(pattern);
+}
+
+TEST(SearchBuffer, StructSize) {
+    auto pattern = compile("error", SCRIBE_IGNORE_CASE);
+    scribe_search_options options;
+    scribe_search_options_init(&options);
+    options.before_context = 1;
+
+    // Fields which are not covered by struct_size are ignored.
+    options.struct_size = offsetof(scribe_search_options, before_context);
+    Results results;
+    EXPECT_EQ(scribe_search_buffer(pattern, &options, log_data.data(), log_data.size(),
+                                   collect, &results),
+              SCRIBE_SUCCESS);
+    EXPECT_EQ(results.matches.size(), 2u);
+
+    options.struct_size = 0;
+    EXPECT_EQ(scribe_search_buffer(pattern, &options, log_data.data(), log_data.size(),
+                                   collect, &results),
+              SCRIBE_INVALID_ARGUMENT);
+    scribe_pattern_free(pattern);
+}
+
+TEST(SearchBuffer, Stop) {
+    auto pattern = compile("");
+    Results results;
+    results.max_matches = 2;
+    EXPECT_EQ(scribe_search_buffer(pattern, nullptr, log_data.data(), log_data.size(), collect,
+                                   &results),
+              SCRIBE_STOPPED);
+    EXPECT_EQ(results.matches.size(), 2u);
+    scribe_pattern_free(pattern);
+}
+
+TEST(SearchBuffer, InvalidMessage) {
+    auto pattern = compile("error");
+    const std::string data = "h {\"id\":1}\nan error\n";
+    Results results;
+    EXPECT_EQ(scribe_search_buffer(pattern, nullptr, data.data(), data.size(), collect,
+                                   &results),
+              SCRIBE_SUCCESS);
+    ASSERT_EQ(results.matches.size(), 1u);
+    EXPECT_EQ(results.matches[0].kind, SCRIBE_INVALID_MESSAGE);
+    EXPECT_EQ(results.messages[0], "an error\n");
+    scribe_pattern_free(pattern);
+}
+
+TEST(SearchFiles, FileIndex) {
+    char path[] = "/tmp/scribe_tests_XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(write(fd, log_data.data(), log_data.size()),
+              static_cast<ssize_t>(log_data.size()));
+    close(fd);
+
+    auto pattern = compile("error");
+    const char *paths[] = {path, path};
+    Results results;
+    EXPECT_EQ(scribe_search_files(pattern, nullptr, paths, 2, collect, &results),
+              SCRIBE_SUCCESS);
+    ASSERT_EQ(results.matches.size(), 2u);
+    EXPECT_EQ(results.matches[0].file, 0u);
+    EXPECT_EQ(results.matches[1].file, 1u);
+    EXPECT_EQ(results.matches[1].line, 2u);
+
+    // Missing files are reported through scribe_last_error.
+    const char *missing[] = {"/this/file/does/not/exist"};
+    EXPECT_EQ(scribe_search_files(pattern, nullptr, missing, 1, collect, &results),
+              SCRIBE_ERROR);
+    EXPECT_NE(std::string(scribe_last_error()).find("/this/file/does/not/exist"),
+              std::string::npos);
+
+    scribe_pattern_free(pattern);
+    unlink(path);
+}
+
+TEST(PatternCompile, Errors) {
+    scribe_pattern *pattern = nullptr;
+    EXPECT_EQ(scribe_pattern_compile("(abc", 0, &pattern), SCRIBE_COMPILE_ERROR);
+    EXPECT_EQ(pattern, nullptr);
+    EXPECT_NE(std::string(scribe_last_error()).find("(abc"), std::string::npos);
+
+    EXPECT_EQ(scribe_pattern_compile(nullptr, 0, &pattern), SCRIBE_INVALID_ARGUMENT);
+    EXPECT_STRNE(scribe_last_error(), "");
+
+    // Exact matching escapes special characters.
+    pattern = compile("(abc", SCRIBE_EXACT_MATCH);
+    const std::string data = "h {\"msg\":\"(abc\"}\n";
+    Results results;
+    EXPECT_EQ(scribe_search_buffer(pattern, nullptr, data.data(), data.size(), collect,
+                                   &results),
+              SCRIBE_SUCCESS);
+    EXPECT_EQ(results.matches.size(), 1u);
+    scribe_pattern_free(pattern);
+}
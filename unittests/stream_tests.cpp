@@ -0,0 +1,235 @@
+#include "gtest/gtest.h"
+#include "policies.hpp"
+#include "stream.hpp"
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace {
+    // A plain substring matcher so tests do not depend on hyperscan.
+    class SubstringMatcher {
+      public:
+        SubstringMatcher(const std::string &pattern, const int) : pattern(pattern) {}
+        bool is_matched(const char *begin, const size_t len) const {
+            return std::string(begin, len).find(pattern) != std::string::npos;
+        }
+
+      private:
+        std::string pattern;
+    };
+
+    struct Message {
+        scribe::MessageKind kind;
+        size_t file;
+        size_t line;
+        std::string text;
+    };
+
+    bool operator==(const Message &lhs, const Message &rhs) {
+        return (lhs.kind == rhs.kind) && (lhs.file == rhs.file) && (lhs.line == rhs.line) &&
+               (lhs.text == rhs.text);
+    }
+
+    std::ostream &operator<<(std::ostream &os, const Message &msg) {
+        return os << "{" << msg.kind << ", " << msg.file << ", " << msg.line << ", "
+                  << msg.text << "}";
+    }
+
+    using Messages = std::vector<Message>;
+
+    struct TestParams {
+        std::string pattern;
+        int regex_mode = 0;
+        size_t before_context = 0;
+        size_t after_context = 0;
+        std::string group_by;
+        size_t group_window = scribe::DEFAULT_GROUP_WINDOW;
+        Messages *results = nullptr;
+
+        bool verbose() const { return false; }
+        bool color() const { return false; }
+        bool silent() const { return false; }
+    };
+
+    class TestOutput {
+      public:
+        template <typename Params> TestOutput(Params &&params) : results(params.results) {}
+        bool operator()(const char *begin, const size_t len, const scribe::MessageInfo &info) {
+            results->push_back(Message{info.kind, info.file, info.line, std::string(begin, len)});
+            return true;
+        }
+
+      private:
+        Messages *results;
+    };
+
+    using Policy = scribe::StreamPolicy<SubstringMatcher, TestOutput>;
+
+    // Feed data to a policy in blocks of a given size, reusing the same read buffer.
+    template <typename StreamPolicy>
+    void process(StreamPolicy &policy, const std::string &data, const size_t block_size) {
+        std::string buffer;
+        for (size_t pos = 0; pos < data.size(); pos += block_size) {
+            buffer.assign(data, pos, block_size);
+            policy.process(buffer.data(), buffer.size());
+            buffer.assign(buffer.size(), '#');
+        }
+        policy.finish();
+    }
+
+    Messages search(const TestParams &params, const std::vector<std::string> &files,
+                    const size_t block_size) {
+        Messages results;
+        TestParams tmp(params);
+        tmp.results = &results;
+        {
+            Policy policy(tmp);
+            for (auto const &data : files) process(policy, data, block_size);
+        }
+        return results;
+    }
+
+    const std::string log_data = "h {\"id\":1}\n"
+                                 "h {\"id\":2}\n"
+                                 "h {\"id\":3,\"msg\":\"error\"}\n"
+                                 "h {\"id\":4}\n"
+                                 "h {\"id\":5,\"msg\":\"error\"}\n"
+                                 "h {\"id\":6}\n"
+                                 "h {\"id\":7}\n"
+                                 "h {\"id\":8}\n";
+} // namespace
+
+TEST(StreamPolicy, Matches) {
+    TestParams params;
+    params.pattern = "error";
+    const Messages expected = {
+        {scribe::MATCHED_MESSAGE, 0, 3, "{\"id\":3,\"msg\":\"error\"}\n"},
+        {scribe::MATCHED_MESSAGE, 0, 5, "{\"id\":5,\"msg\":\"error\"}\n"},
+    };
+    EXPECT_EQ(search(params, {log_data}, log_data.size()), expected);
+}
+
+TEST(StreamPolicy, ReadBufferBoundary) {
+    TestParams params;
+    params.pattern = "error";
+    const Messages expected = search(params, {log_data}, log_data.size());
+
+    // Lines which span read buffers are assembled in the line buffer.
+    for (size_t block_size = 1; block_size < 32; ++block_size) {
+        EXPECT_EQ(search(params, {log_data}, block_size), expected) << block_size;
+    }
+
+    // The last line does not have a newline.
+    const std::string data = "h {\"id\":1}\nh {\"msg\":\"error\"}";
+    const Messages last = {{scribe::MATCHED_MESSAGE, 0, 2, "{\"msg\":\"error\"}"}};
+    EXPECT_EQ(search(params, {data}, 5), last);
+}
+
+TEST(StreamPolicy, InvalidMessage) {
+    TestParams params;
+    params.pattern = "error";
+    const Messages expected = {{scribe::INVALID_MESSAGE, 0, 2, "an error\n"}};
+    EXPECT_EQ(search(params, {"h {\"id\":1}\nan error\n"}, 4), expected);
+}
+
+TEST(StreamPolicy, ContextOverlap) {
+    TestParams params;
+    params.pattern = "error";
+    params.before_context = 2;
+    params.after_context = 1;
+
+    // Lines shared by the context of two matches are printed once.
+    const Messages expected = {
+        {scribe::CONTEXT_MESSAGE, 0, 1, "{\"id\":1}\n"},
+        {scribe::CONTEXT_MESSAGE, 0, 2, "{\"id\":2}\n"},
+        {scribe::MATCHED_MESSAGE, 0, 3, "{\"id\":3,\"msg\":\"error\"}\n"},
+        {scribe::CONTEXT_MESSAGE, 0, 4, "{\"id\":4}\n"},
+        {scribe::MATCHED_MESSAGE, 0, 5, "{\"id\":5,\"msg\":\"error\"}\n"},
+        {scribe::CONTEXT_MESSAGE, 0, 6, "{\"id\":6}\n"},
+    };
+    for (size_t block_size : {3, 7, 11, 1000}) {
+        EXPECT_EQ(search(params, {log_data}, block_size), expected) << block_size;
+    }
+}
+
+TEST(StreamPolicy, RawOutput) {
+    TestParams params;
+    params.pattern = "error";
+    params.before_context = 1;
+
+    // Blocks of lines which are not adjacent are separated like grep does.
+    testing::internal::CaptureStdout();
+    {
+        scribe::StreamPolicy<SubstringMatcher> policy(params);
+        process(policy, log_data, 1000);
+        process(policy, log_data, 1000);
+        fflush(stdout);
+    }
+    const std::string block = "{\"id\":2}\n"
+                              "{\"id\":3,\"msg\":\"error\"}\n"
+                              "{\"id\":4}\n"
+                              "{\"id\":5,\"msg\":\"error\"}\n";
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), block + "--\n" + block);
+}
+
+TEST(StreamPolicy, GroupExpiry) {
+    const std::string data = "h {\"g\":\"a\"}\n"                  // 1
+                             "h {\"g\":\"b\"}\n"                  // 2
+                             "h {\"g\":\"a\",\"msg\":\"error\"}\n" // 3
+                             "h {\"g\":\"a\"}\n"                  // 4
+                             "h {\"g\":\"b\"}\n"                  // 5
+                             "h {\"g\":\"a\"}\n"                  // 6
+                             "h {\"g\":\"a\"}\n";                 // 7
+    TestParams params;
+    params.pattern = "error";
+    params.group_by = "g";
+    params.group_window = 3;
+
+    // Group a is active until line 3 + 3, so line 7 is not printed.
+    const Messages expected = {
+        {scribe::GROUP_MESSAGE, 0, 1, "{\"g\":\"a\"}\n"},
+        {scribe::MATCHED_MESSAGE, 0, 3, "{\"g\":\"a\",\"msg\":\"error\"}\n"},
+        {scribe::GROUP_MESSAGE, 0, 4, "{\"g\":\"a\"}\n"},
+        {scribe::GROUP_MESSAGE, 0, 6, "{\"g\":\"a\"}\n"},
+    };
+    for (size_t block_size : {5, 13, 1000}) {
+        EXPECT_EQ(search(params, {data}, block_size), expected) << block_size;
+    }
+}
+
+TEST(StreamPolicy, MultipleFiles) {
+    const std::string first = "h {\"id\":1}\n"
+                              "h {\"id\":2,\"msg\":\"error\"}\n"
+                              "h {\"id\":3}\n"
+                              "h {\"g\":\"a\"}\n"
+                              "h {\"id\":4}";
+    const std::string second = "h {\"g\":\"a\"}\n"
+                               "h {\"id\":5,\"msg\":\"error\"}\n";
+
+    // Neither the partial last line nor context lines are carried over to the next file.
+    TestParams params;
+    params.pattern = "error";
+    params.before_context = 2;
+    params.after_context = 1;
+    const Messages context = {
+        {scribe::CONTEXT_MESSAGE, 0, 1, "{\"id\":1}\n"},
+        {scribe::MATCHED_MESSAGE, 0, 2, "{\"id\":2,\"msg\":\"error\"}\n"},
+        {scribe::CONTEXT_MESSAGE, 0, 3, "{\"id\":3}\n"},
+        {scribe::CONTEXT_MESSAGE, 1, 1, "{\"g\":\"a\"}\n"},
+        {scribe::MATCHED_MESSAGE, 1, 2, "{\"id\":5,\"msg\":\"error\"}\n"},
+    };
+    EXPECT_EQ(search(params, {first, second}, 6), context);
+
+    // Groups are not carried over either.
+    params.before_context = 0;
+    params.after_context = 0;
+    params.group_by = "id";
+    params.group_window = 10;
+    const std::string third = "h {\"id\":\"x\",\"msg\":\"error\"}\n";
+    const std::string fourth = "h {\"id\":\"x\"}\n";
+    const Messages groups = {
+        {scribe::MATCHED_MESSAGE, 0, 1, "{\"id\":\"x\",\"msg\":\"error\"}\n"},
+    };
+    EXPECT_EQ(search(params, {third, fourth}, 4), groups);
+}